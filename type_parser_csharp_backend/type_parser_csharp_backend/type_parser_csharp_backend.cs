@@ -14,6 +14,7 @@ namespace ns_type_parser_csharp_backend
       public string abMemberName; /* for members of structs, enums, unions */
       public int iSize;
       public int iAlignment;
+      public int iOffset; /* for members of structs and unions */
 
       public enum Kind
       {
@@ -61,6 +62,7 @@ namespace ns_type_parser_csharp_backend
       t.eKind = (Type.Kind)br.ReadInt32();
       t.iSize = br.ReadInt32();
       t.iAlignment = br.ReadInt32();
+      t.iOffset = br.ReadInt32();
       t.fIsConstValue = (br.ReadInt32() != 0);
       t.iConstValue = br.ReadInt64();
       t.numChildren = br.ReadInt32();
@@ -75,38 +77,102 @@ namespace ns_type_parser_csharp_backend
         typeList.Add(t);
     }
 
-    private static bool loadPacketDump(string file)
+    /* Read one database image, as written by the frontend for a single target, into typeList and defineList */
+    private static bool readDatabase(System.IO.BinaryReader br)
+    {
+      UInt32 fileMagic = br.ReadUInt32();
+      UInt32 version = br.ReadUInt32();
+      if ((fileMagic != 0x7db0c0de) || (version != 2))
+        return false;
+      br.ReadUInt64(); /* content hash */
+
+      /* per-type hashes, only needed to detect which types changed */
+      UInt32 numTypeHashes = br.ReadUInt32();
+      for (int i = 0; i < numTypeHashes; i++)
+      {
+        readString(br);
+        br.ReadUInt64();
+      }
+
+      UInt32 magic = br.ReadUInt32();
+      if (magic != 0x23c0ffee)
+        return false;
+      UInt32 numTypes = br.ReadUInt32();
+      for (int i = 0; i < numTypes; i++)
+        deserialize_packet(br, null);
+
+      UInt32 magic2 = br.ReadUInt32();
+      if (magic2 != 0x12021984)
+        return false;
+      UInt32 numDefines = br.ReadUInt32();
+      for (int i = 0; i < numDefines; i++)
+      {
+        Define d = new Define();
+        d.abName = readString(br);
+        d.abValue = readString(br);
+        defineList.Add(d);
+      }
+      return true;
+    }
+
+    /*
+     * Load a single target database, or the database of "target" (default: the first one) from a multi-target
+     * database: magic 0x7a26e7ed, version, content hash, number of targets, target names, one database image per target
+     */
+    private static bool loadPacketDump(string file, string target)
     {
       try
       {
         System.IO.FileStream fs = new System.IO.FileStream(file, System.IO.FileMode.Open);
         System.IO.BinaryReader br = new System.IO.BinaryReader(fs);
-        UInt32 magic = br.ReadUInt32();
-        if (magic != 0x23c0ffee)
+        bool fValid;
+        if (br.ReadUInt32() != 0x7a26e7ed)
         {
-          System.Console.WriteLine("This is not a valid packet dump");
-          return false;
+          if (target != null)
+          {
+            System.Console.WriteLine("This is a single target packet dump, it has no target " + target);
+            br.Close();
+            return false;
+          }
+          fs.Position = 0;
+          fValid = readDatabase(br);
         }
-        UInt32 numTypes = br.ReadUInt32();
-        for (int i = 0; i < numTypes; i++)
-          deserialize_packet(br, null);
+        else
+        {
+          UInt32 version = br.ReadUInt32();
+          br.ReadUInt64(); /* content hash */
+          UInt32 numTargets = br.ReadUInt32();
+          List<string> targets = new List<string>();
+          for (int i = 0; i < numTargets; i++)
+            targets.Add(readString(br));
+
+          int selected = (target == null) ? 0 : targets.IndexOf(target);
+          if ((version != 2) || (numTargets == 0))
+            fValid = false;
+          else if (selected < 0)
+          {
+            System.Console.WriteLine("No target " + target + " in the packet dump, it has " + string.Join(", ", targets));
+            fValid = false;
+          }
+          else
+          {
+            /* the databases have no length, the ones in front of the selected one are read and dropped */
+            fValid = true;
+            for (int i = 0; (i <= selected) && fValid; i++)
+            {
+              typeList.Clear();
+              defineList.Clear();
+              fValid = readDatabase(br);
+            }
+          }
+        }
+        br.Close();
 
-        UInt32 magic2 = br.ReadUInt32();
-        if (magic2 != 0x12021984)
+        if (!fValid)
         {
           System.Console.WriteLine("This is not a valid packet dump");
           return false;
         }
-        UInt32 numDefines = br.ReadUInt32();
-        for (int i = 0; i < numDefines; i++)
-        {
-          Define d = new Define();
-          d.abName = readString(br);
-          d.abValue = readString(br);
-          defineList.Add(d);
-        }
-
-        br.Close();
       }
       catch (Exception)
       {
@@ -302,9 +368,9 @@ namespace ns_type_parser_csharp_backend
 
     static void Main(string[] args)
     {
-      if (args.Length != 1)
+      if ((args.Length < 1) || (args.Length > 2))
       {
-        System.Console.WriteLine("Usage: this_program.exe <input file as created by frontend>.bin");
+        System.Console.WriteLine("Usage: this_program.exe <input file as created by frontend>.bin [<target of a multi-target file>]");
         return;
       }
 
@@ -314,29 +380,18 @@ namespace ns_type_parser_csharp_backend
         return;
       }
       
-      if (!loadPacketDump(args[0]))
+      if (!loadPacketDump(args[0], (args.Length > 1) ? args[1] : null))
       {
         System.Console.WriteLine("Failed to load packet dump");
         return;
       }
 
-      /* uniq */
-      List<Define> uniqueDefines = new List<Define>();
+      /* the parser writes each define once, this just guards against duplicates */
+      HashSet<string> emittedDefines = new HashSet<string>();
       foreach (Define d in defineList)
       {
-        bool fAlreadyContained = false;
-        foreach (Define d2 in uniqueDefines)
-        {
-          if (d2.abName == d.abName)
-            fAlreadyContained = true;
-        }
-
-        if (!fAlreadyContained)
-          uniqueDefines.Add(d);
-      }
-      foreach (Define d in uniqueDefines)
-      {
-        System.Console.WriteLine("public const uint " + d.abName + " = " + d.abValue + ";");
+        if (emittedDefines.Add(d.abName))
+          System.Console.WriteLine("public const uint " + d.abName + " = " + d.abValue + ";");
       }
       System.Console.WriteLine("\n");
 